@@ -0,0 +1,83 @@
+#include "feedrate.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+/* Not part of ctest; timings depend on the host.
+ * Cold solves include the solver's stderr trace, run with 2>/dev/null.
+ * */
+
+using bench_clock = std::chrono::steady_clock;
+
+static double seconds_since(bench_clock::time_point start) {
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+static std::vector<TaggedValue> tool_inputs() {
+    return {
+        {tag_FeedPerTooth, 0.012},
+        {tag_CutterDiameterAtDepthOfCut, 4},
+        {tag_CutterTeeth, 4},
+        {tag_CutterOverhang, 20},
+        {tag_CutterMaterialElasticity, 650000},
+        {tag_CuttingSpeed, 3},
+        {tag_SpecificCuttingForce, 1500},
+        {tag_MaterialTensileStrength, 440},
+        {tag_DepthOfCut, 0.6},
+        {tag_WorkingEngagement, 4},
+        {tag_EffectiveCutterTeeth, 4},
+    };
+}
+
+static std::vector<TaggedValue> tool_outputs() {
+    return {
+        {tag_TableFeed, 0},
+        {tag_SpindleSpeed, 0},
+        {tag_MaterialRemovalRate, 0},
+        {tag_NetPower, 0},
+        {tag_Torque, 0},
+        {tag_Deflection, 0},
+        {tag_TangentialForce, 0},
+    };
+}
+
+// Average seconds per calculate() call over runs calls on one thread.
+static double latency(unsigned runs) {
+    auto in = tool_inputs();
+    auto out = tool_outputs();
+    calculate(in.data(), in.size(), out.data(), out.size());
+    auto start = bench_clock::now();
+    for (unsigned i = 0; i < runs; ++i)
+        calculate(in.data(), in.size(), out.data(), out.size());
+    return seconds_since(start) / runs;
+}
+
+// Calls per second with every thread requesting the same inputs.
+static double hot_key_throughput(unsigned threads, unsigned calls) {
+    std::vector<std::thread> workers;
+    auto start = bench_clock::now();
+    for (unsigned t = 0; t < threads; ++t)
+        workers.emplace_back([calls] {
+            auto in = tool_inputs();
+            auto out = tool_outputs();
+            for (unsigned i = 0; i < calls; ++i)
+                calculate(in.data(), in.size(), out.data(), out.size());
+        });
+    for (auto& w : workers)
+        w.join();
+    return threads * calls / seconds_since(start);
+}
+
+int main() {
+    calculate_cache_limit(0);
+    double cold = latency(2000);
+    calculate_cache_limit(16 * 1024 * 1024);
+    double hit = latency(200000);
+    printf("cold solve: %.3f us\ncache hit:  %.3f us\n", cold * 1e6, hit * 1e6);
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= std::max(8u, cores); threads *= 2)
+        printf("hot key, %2u threads: %6.2f Mcalls/s\n", threads, hot_key_throughput(threads, 200000) / 1e6);
+}
@@ -0,0 +1,352 @@
+#include "cache.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace cache {
+
+namespace {
+
+constexpr unsigned shard_count = 16;
+constexpr std::size_t default_limit = 16 * 1024 * 1024;
+
+std::atomic<std::size_t> limit{default_limit};
+// Bumped by clear() and set_limit() to invalidate every thread's front cache.
+std::atomic<std::uint64_t> epoch{1};
+
+std::uint64_t bits(double d) {
+    std::uint64_t b;
+    std::memcpy(&b, &d, sizeof(b));
+    return b;
+}
+
+std::uint64_t mix(std::uint64_t h, std::uint64_t v) {
+    // FNV-1a style combine followed by a final avalanche in make_key
+    h ^= v;
+    h *= 0x100000001b3ull;
+    return h;
+}
+
+/* Hit / miss counters are bumped on every lookup, so a single shared
+ * counter would bounce between cores just like a lock would. Each thread
+ * is assigned one of several cache-line sized slots instead.
+ * */
+struct counter {
+    static constexpr unsigned stripes = 64;
+    struct alignas(64) slot {
+        std::atomic<unsigned long long> n{0};
+    };
+    slot slots[stripes];
+
+    static unsigned stripe() {
+        static std::atomic<unsigned> next{0};
+        thread_local unsigned index = next.fetch_add(1, std::memory_order_relaxed) % stripes;
+        return index;
+    }
+    void add() {
+        slots[stripe()].n.fetch_add(1, std::memory_order_relaxed);
+    }
+    unsigned long long sum() const {
+        unsigned long long n = 0;
+        for (auto& s : slots)
+            n += s.n.load(std::memory_order_relaxed);
+        return n;
+    }
+    void reset() {
+        for (auto& s : slots)
+            s.n.store(0, std::memory_order_relaxed);
+    }
+};
+
+counter hits;
+counter misses;
+
+// The key hash is already mixed; use it directly for the index buckets.
+struct hash_bits {
+    std::size_t operator()(std::uint64_t h) const {
+        return static_cast<std::size_t>(h);
+    }
+};
+
+// Stored key and output values; shared by shard entries and the front cache.
+struct record {
+    void assign(const probe& p, const double* v) {
+        in.assign(p.in, p.in + p.in_size);
+        out.clear();
+        for (unsigned i = 0; i < p.out_size; ++i)
+            out.push_back(p.out[i].tag);
+        hash = p.hash;
+        values.assign(v, v + p.out_size);
+    }
+
+    bool matches(const probe& p) const {
+        if (hash != p.hash || in.size() != p.in_size || out.size() != p.out_size)
+            return false;
+        for (unsigned i = 0; i < p.out_size; ++i)
+            if (out[i] != p.out[i].tag)
+                return false;
+        for (unsigned i = 0; i < p.in_size; ++i)
+            if (in[i].tag != p.in[i].tag || bits(in[i].value) != bits(p.in[i].value))
+                return false;
+        return true;
+    }
+
+    std::vector<TaggedValue> in;
+    std::vector<unsigned> out;
+    std::uint64_t hash = 0;
+    std::vector<double> values;
+};
+
+struct entry : record {
+    std::size_t bytes = 0;
+    std::atomic<bool> referenced{false};  // set on hit, cleared by the eviction sweep
+};
+
+/* Per-thread, direct-mapped cache in front of the shards. A repeat hit on
+ * a hot key only reads the shared epoch, so it writes no cache line that
+ * another core also uses. Results depend only on the key, so a front entry
+ * stays correct after its shard entry is evicted. Only clear() and
+ * set_limit() invalidate it, by bumping the epoch. This memory is per
+ * thread and bounded by front_size, and is not counted against the limit.
+ * */
+struct front_slot {
+    record r;
+    std::uint64_t epoch = 0;
+};
+constexpr unsigned front_size = 64;
+
+front_slot& front_for(std::uint64_t hash) {
+    thread_local front_slot slots[front_size];
+    return slots[hash % front_size];
+}
+
+void fill_front(const probe& p, const double* values, std::uint64_t now) {
+    auto& f = front_for(p.hash);
+    f.r.assign(p, values);
+    f.epoch = now;
+}
+
+struct alignas(64) shard {
+    using lru_list = std::list<entry>;
+
+    // Lookups hold the lock shared; only insert / evict / clear hold it exclusively.
+    std::shared_timed_mutex mutex;
+    lru_list lru;       // newest at front
+    std::unordered_multimap<std::uint64_t, lru_list::iterator, hash_bits> index;
+    std::size_t bytes = 0;
+    unsigned long long evictions = 0;
+
+    /* Second-chance (CLOCK) approximation of LRU: hits only set a flag, so
+     * repeated hits on one key never need the exclusive lock. Referenced
+     * entries at the tail get their flag cleared and move back to the front.
+     * */
+    void trim(std::size_t max) {
+        while (bytes > max && !lru.empty()) {
+            auto& e = lru.back();
+            if (e.referenced.load(std::memory_order_relaxed)) {
+                e.referenced.store(false, std::memory_order_relaxed);
+                lru.splice(lru.begin(), lru, std::prev(lru.end()));
+                continue;
+            }
+            unindex(e.hash, std::prev(lru.end()));
+            bytes -= e.bytes;
+            lru.pop_back();
+            ++evictions;
+        }
+    }
+
+    lru_list::iterator find(const probe& p) {
+        auto range = index.equal_range(p.hash);
+        for (auto it = range.first; it != range.second; ++it)
+            if (it->second->matches(p))
+                return it->second;
+        return lru.end();
+    }
+
+    void unindex(std::uint64_t hash, lru_list::iterator e) {
+        auto range = index.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it)
+            if (it->second == e) {
+                index.erase(it);
+                return;
+            }
+    }
+};
+
+shard shards[shard_count];
+
+shard& shard_for(std::uint64_t hash) {
+    // Top bits select the shard; the index buckets use the low bits.
+    return shards[(hash >> 32) % shard_count];
+}
+
+std::size_t cost(const entry& e) {
+    // Approximate: list node (entry + 2 links), index node (pair + next link + bucket),
+    // and heap storage for the key and values
+    return sizeof(entry) + 2 * sizeof(void*) +
+        sizeof(std::uint64_t) + sizeof(shard::lru_list::iterator) + 2 * sizeof(void*) +
+        e.in.capacity() * sizeof(TaggedValue) +
+        e.out.capacity() * sizeof(unsigned) +
+        e.values.capacity() * sizeof(double);
+}
+
+}
+
+bool enabled() {
+    return limit.load(std::memory_order_relaxed) != 0;
+}
+
+probe::probe(const TaggedValue* in, unsigned in_size, const TaggedValue* out, unsigned out_size)
+ : in(nullptr), in_size(in_size), out(out), out_size(out_size), hash(0) {
+    TaggedValue* sorted = local;
+    if (in_size > inline_size) {
+        heap.resize(in_size);
+        sorted = heap.data();
+    }
+    std::copy(in, in + in_size, sorted);
+    // Stable so that duplicate tags keep their relative order; calculate() uses the first.
+    // Insertion sort: input sets are small and std::stable_sort may allocate.
+    for (unsigned i = 1; i < in_size; ++i) {
+        auto v = sorted[i];
+        unsigned j = i;
+        for (; j > 0 && sorted[j - 1].tag > v.tag; --j)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = v;
+    }
+    this->in = sorted;
+
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned i = 0; i < in_size; ++i)
+        h = mix(mix(h, sorted[i].tag), bits(sorted[i].value));
+    h = mix(h, in_size);
+    for (unsigned i = 0; i < out_size; ++i)
+        h = mix(h, out[i].tag);
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    hash = h;
+}
+
+bool lookup(const probe& p, TaggedValue* out) {
+    // Read before the shard so a racing clear() leaves the front slot stale, not live.
+    auto now = epoch.load(std::memory_order_acquire);
+    auto& f = front_for(p.hash);
+    if (f.epoch == now && f.r.matches(p)) {
+        hits.add();
+        for (unsigned i = 0; i < p.out_size; ++i)
+            out[i].value = f.r.values[i];
+        return true;
+    }
+
+    auto& s = shard_for(p.hash);
+    std::shared_lock<std::shared_timed_mutex> lock(s.mutex);
+    auto it = s.find(p);
+    if (it == s.lru.end()) {
+        misses.add();
+        return false;
+    }
+    hits.add();
+    auto& e = *it;
+    // Test before set so hot entries stay read-only and their cache line shared.
+    if (!e.referenced.load(std::memory_order_relaxed))
+        e.referenced.store(true, std::memory_order_relaxed);
+    for (unsigned i = 0; i < p.out_size; ++i)
+        out[i].value = e.values[i];
+    fill_front(p, e.values.data(), now);
+    return true;
+}
+
+void insert(const probe& p, const TaggedValue* out) {
+    if (!enabled())
+        return;
+    auto now = epoch.load(std::memory_order_acquire);
+
+    // Build the entry outside the exclusive lock; its node is spliced in below.
+    shard::lru_list node;
+    node.emplace_front();
+    auto& e = node.front();
+    std::vector<double> values(p.out_size);
+    for (unsigned i = 0; i < p.out_size; ++i)
+        values[i] = out[i].value;
+    e.assign(p, values.data());
+    e.bytes = cost(e);
+
+    auto& s = shard_for(p.hash);
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(s.mutex);
+        if (s.find(p) != s.lru.end()) {
+            // another thread solved the same inputs first
+            fill_front(p, values.data(), now);
+            return;
+        }
+    }
+
+    std::lock_guard<std::shared_timed_mutex> lock(s.mutex);
+    // Re-read under the shard lock; set_limit() trims each shard under the
+    // same lock so a racing insert either sees the new limit or is trimmed.
+    std::size_t max = limit.load(std::memory_order_relaxed) / shard_count;
+    if (e.bytes > max)
+        return;
+    fill_front(p, values.data(), now);
+    if (s.find(p) != s.lru.end())
+        return;
+    s.lru.splice(s.lru.begin(), node);
+    s.index.emplace(p.hash, s.lru.begin());
+    s.bytes += e.bytes;
+    s.trim(max);
+}
+
+void set_limit(std::size_t bytes) {
+    limit.store(bytes, std::memory_order_relaxed);
+    epoch.fetch_add(1, std::memory_order_release);
+    for (auto& s : shards) {
+        std::lock_guard<std::shared_timed_mutex> lock(s.mutex);
+        s.trim(bytes / shard_count);
+    }
+}
+
+void clear() {
+    epoch.fetch_add(1, std::memory_order_release);
+    for (auto& s : shards) {
+        std::lock_guard<std::shared_timed_mutex> lock(s.mutex);
+        s.index.clear();
+        s.lru.clear();
+        s.bytes = 0;
+        s.evictions = 0;
+    }
+    hits.reset();
+    misses.reset();
+}
+
+void stats(CacheStats* out) {
+    *out = {};
+    out->limit = limit.load(std::memory_order_relaxed);
+    out->hits = hits.sum();
+    out->misses = misses.sum();
+    for (auto& s : shards) {
+        std::shared_lock<std::shared_timed_mutex> lock(s.mutex);
+        out->evictions += s.evictions;
+        out->entries += s.lru.size();
+        out->bytes += s.bytes;
+    }
+}
+
+}
+
+extern "C" void calculate_cache_limit(size_t bytes) {
+    cache::set_limit(bytes);
+}
+
+extern "C" void calculate_cache_clear(void) {
+    cache::clear();
+}
+
+extern "C" void calculate_cache_stats(CacheStats* stats) {
+    if (stats)
+        cache::stats(stats);
+}
@@ -0,0 +1,50 @@
+#ifndef CACHE_H
+#define CACHE_H
+#include "feedrate.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Result cache for calculate().
+ * Entries are keyed by the input set sorted by tag plus the requested
+ * output tags (in request order). The key space is split over a fixed
+ * number of shards, each with its own reader / writer lock and eviction
+ * list. Each thread also keeps a small front cache of recent results, so
+ * repeated hits on a hot key touch no shared lock.
+ * */
+namespace cache {
+
+bool enabled();
+
+/* Sorted view of one calculate() request, used to look up and insert.
+ * Typical input sets are sorted into an inline buffer and the output tags
+ * are read from the caller's array, so probing does not allocate.
+ * */
+struct probe {
+    probe(const TaggedValue* in, unsigned in_size, const TaggedValue* out, unsigned out_size);
+    probe(const probe&) = delete;
+    probe& operator=(const probe&) = delete;
+
+    const TaggedValue* in;      // stable sorted by tag
+    unsigned in_size;
+    const TaggedValue* out;     // only the tags are part of the key
+    unsigned out_size;
+    std::uint64_t hash;
+
+private:
+    static constexpr unsigned inline_size = 32;
+    TaggedValue local[inline_size];
+    std::vector<TaggedValue> heap;
+};
+
+// Copies cached output values into out on hit.
+bool lookup(const probe& p, TaggedValue* out);
+void insert(const probe& p, const TaggedValue* out);
+
+void set_limit(std::size_t bytes);
+void clear();
+void stats(CacheStats* s);
+
+}
+
+#endif
@@ -11,6 +11,7 @@
 #include <cstring>
 #include "id.h"
 #include "utils.h"
+#include "cache.h"
 
 
 // http://www.sandvik.coromant.com/en-us/knowledge/milling/formulas_and_definitions/formulas
@@ -152,7 +153,7 @@ void for_each(const std::tuple<Args...>& t, Fn fn) {
     detail::for_each(t, fn, std::index_sequence_for<Args...>{});
 }
 
-extern "C" bool calculate(const TaggedValue* in, unsigned in_size, TaggedValue* out, unsigned out_size) {
+static bool solve(const TaggedValue* in, unsigned in_size, TaggedValue* out, unsigned out_size) {
     static constexpr auto t = std::make_tuple
         (
          id::Vc(), 
@@ -168,9 +169,6 @@ extern "C" bool calculate(const TaggedValue* in, unsigned in_size, TaggedValue*
          id::Fc()
         );
 
-    if (in_size == 0 || out_size == 0)
-        return false;
-
     std::vector<TaggedValue> values(in, in+in_size);
 
     auto exists = [&](uint32_t tag) {
@@ -204,3 +202,19 @@ extern "C" bool calculate(const TaggedValue* in, unsigned in_size, TaggedValue*
     return true;
 }
 
+extern "C" bool calculate(const TaggedValue* in, unsigned in_size, TaggedValue* out, unsigned out_size) {
+    if (in_size == 0 || out_size == 0)
+        return false;
+
+    if (!cache::enabled())
+        return solve(in, in_size, out, out_size);
+
+    cache::probe key(in, in_size, out, out_size);
+    if (cache::lookup(key, out))
+        return true;
+
+    if (!solve(in, in_size, out, out_size))
+        return false;
+    cache::insert(key, out);
+    return true;
+}
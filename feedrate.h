@@ -1,6 +1,7 @@
 #ifndef FEEDRATE_H
 #define FEEDRATE_H
 #include "tag.h"
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,6 +15,21 @@ struct TaggedValue {
 
 bool calculate(const TaggedValue* in, unsigned in_size, TaggedValue* out, unsigned out_size);
 
+// Successful calculate() results are cached, keyed on the input set
+// (order independent) and the requested output tags.
+struct CacheStats {
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+    size_t entries;
+    size_t bytes;           // approximate memory in use
+    size_t limit;           // memory cap, 0 disables the cache
+};
+
+void calculate_cache_limit(size_t bytes);
+void calculate_cache_clear(void);
+void calculate_cache_stats(struct CacheStats* stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,217 @@
+#include "feedrate.h"
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++failures; \
+        } \
+    } while (0)
+
+static CacheStats stats() {
+    CacheStats s;
+    calculate_cache_stats(&s);
+    return s;
+}
+
+static std::vector<TaggedValue> tool_inputs() {
+    return {
+        {tag_FeedPerTooth, 0.012},
+        {tag_CutterDiameterAtDepthOfCut, 4},
+        {tag_CutterTeeth, 4},
+        {tag_CutterOverhang, 20},
+        {tag_CutterMaterialElasticity, 650000},
+        {tag_CuttingSpeed, 3},
+        {tag_SpecificCuttingForce, 1500},
+        {tag_MaterialTensileStrength, 440},
+        {tag_DepthOfCut, 0.6},
+        {tag_WorkingEngagement, 4},
+        {tag_EffectiveCutterTeeth, 4},
+    };
+}
+
+static std::vector<TaggedValue> tool_outputs() {
+    return {
+        {tag_TableFeed, 0},
+        {tag_SpindleSpeed, 0},
+        {tag_MaterialRemovalRate, 0},
+        {tag_NetPower, 0},
+        {tag_Torque, 0},
+        {tag_Deflection, 0},
+        {tag_TangentialForce, 0},
+    };
+}
+
+static double spindle_speed(double cutting_speed) {
+    TaggedValue in[] = {{tag_CuttingSpeed, cutting_speed}, {tag_CutterDiameterAtDepthOfCut, 4}};
+    TaggedValue out[] = {{tag_SpindleSpeed, 0}};
+    if (!calculate(in, 2, out, 1))
+        return -1;
+    return out[0].value;
+}
+
+static void test_permuted_hit() {
+    auto in = tool_inputs();
+
+    calculate_cache_limit(0);
+    auto cold = tool_outputs();
+    CHECK(calculate(in.data(), in.size(), cold.data(), cold.size()));
+
+    calculate_cache_limit(1 << 20);
+    calculate_cache_clear();
+    auto first = tool_outputs();
+    CHECK(calculate(in.data(), in.size(), first.data(), first.size()));
+    CHECK(stats().misses == 1 && stats().hits == 0);
+
+    std::reverse(in.begin(), in.end());
+    std::rotate(in.begin(), in.begin() + 3, in.end());
+    auto hit = tool_outputs();
+    CHECK(calculate(in.data(), in.size(), hit.data(), hit.size()));
+    CHECK(stats().hits == 1);
+    CHECK(stats().entries == 1);
+    for (unsigned i = 0; i < cold.size(); ++i) {
+        CHECK(hit[i].tag == cold[i].tag);
+        CHECK(hit[i].value == cold[i].value);
+    }
+
+    // Different output tags are a different key
+    auto subset = tool_outputs();
+    subset.resize(2);
+    CHECK(calculate(in.data(), in.size(), subset.data(), subset.size()));
+    CHECK(stats().misses == 2 && stats().entries == 2);
+}
+
+static void test_failed_solve() {
+    calculate_cache_clear();
+    TaggedValue in[] = {{tag_CuttingSpeed, 3}};
+    TaggedValue out[] = {{tag_SpindleSpeed, 0}};
+    CHECK(!calculate(in, 1, out, 1));
+    CHECK(!calculate(in, 1, out, 1));
+
+    auto s = stats();
+    CHECK(s.hits == 0 && s.misses == 2);
+    CHECK(s.entries == 0 && s.bytes == 0);
+}
+
+static void test_output_order() {
+    calculate_cache_clear();
+    auto in = tool_inputs();
+    TaggedValue first[] = {{tag_TableFeed, 0}, {tag_SpindleSpeed, 0}};
+    TaggedValue swapped[] = {{tag_SpindleSpeed, 0}, {tag_TableFeed, 0}};
+    CHECK(calculate(in.data(), in.size(), first, 2));
+    CHECK(calculate(in.data(), in.size(), swapped, 2));
+
+    auto s = stats();
+    CHECK(s.hits == 0 && s.misses == 2 && s.entries == 2);
+    CHECK(swapped[0].value == first[1].value);
+    CHECK(swapped[1].value == first[0].value);
+}
+
+static double spindle_speed(const TaggedValue* in, unsigned n) {
+    TaggedValue out[] = {{tag_SpindleSpeed, 0}};
+    if (!calculate(in, n, out, 1))
+        return -1;
+    return out[0].value;
+}
+
+static void test_duplicate_tags() {
+    // calculate() uses the first value given for a tag
+    TaggedValue in[] = {{tag_CuttingSpeed, 3}, {tag_CutterDiameterAtDepthOfCut, 4}, {tag_CuttingSpeed, 6}};
+    TaggedValue moved[] = {{tag_CutterDiameterAtDepthOfCut, 4}, {tag_CuttingSpeed, 3}, {tag_CuttingSpeed, 6}};
+    TaggedValue reversed[] = {{tag_CuttingSpeed, 6}, {tag_CutterDiameterAtDepthOfCut, 4}, {tag_CuttingSpeed, 3}};
+
+    calculate_cache_limit(0);
+    double expected = spindle_speed(in, 3);
+    double expected_reversed = spindle_speed(reversed, 3);
+    CHECK(expected != expected_reversed);
+
+    calculate_cache_limit(1 << 20);
+    calculate_cache_clear();
+    CHECK(spindle_speed(in, 3) == expected);
+    CHECK(spindle_speed(moved, 3) == expected);
+    CHECK(stats().hits == 1 && stats().misses == 1);
+
+    // Reordering the duplicates changes which value wins, so it is a different key
+    CHECK(spindle_speed(reversed, 3) == expected_reversed);
+    CHECK(stats().hits == 1 && stats().misses == 2);
+}
+
+static void test_limit() {
+    const size_t limit = 4096;
+    calculate_cache_clear();
+    calculate_cache_limit(limit);
+    for (unsigned i = 0; i < 200; ++i)
+        CHECK(spindle_speed(1 + i) > 0);
+
+    auto s = stats();
+    CHECK(s.limit == limit);
+    CHECK(s.misses == 200);
+    CHECK(s.evictions > 0);
+    CHECK(s.entries < 200);
+    CHECK(s.entries + s.evictions == 200);
+    CHECK(s.bytes <= limit);
+
+    calculate_cache_limit(0);
+    s = stats();
+    CHECK(s.entries == 0 && s.bytes == 0);
+    CHECK(spindle_speed(1) > 0);
+    CHECK(stats().entries == 0);
+
+    calculate_cache_limit(1 << 20);
+    calculate_cache_clear();
+    s = stats();
+    CHECK(s.hits == 0 && s.misses == 0 && s.evictions == 0 && s.entries == 0);
+}
+
+static void test_threads() {
+    const unsigned keys = 32;
+    const unsigned threads = 8;
+    const unsigned calls = 4000;
+
+    calculate_cache_limit(0);
+    std::vector<double> expected;
+    for (unsigned k = 0; k < keys; ++k)
+        expected.push_back(spindle_speed(1 + k));
+
+    calculate_cache_limit(1 << 20);
+    calculate_cache_clear();
+    std::vector<unsigned> wrong(threads);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t)
+        workers.emplace_back([&, t] {
+            for (unsigned i = 0; i < calls; ++i) {
+                unsigned k = (i + t) % keys;
+                if (spindle_speed(1 + k) != expected[k])
+                    ++wrong[t];
+            }
+        });
+    for (auto& w : workers)
+        w.join();
+
+    for (auto n : wrong)
+        CHECK(n == 0);
+    auto s = stats();
+    CHECK(s.hits + s.misses == threads * calls);
+    CHECK(s.misses >= keys);
+    CHECK(s.entries == keys);
+    CHECK(s.evictions == 0);
+}
+
+int main() {
+    test_permuted_hit();
+    test_failed_solve();
+    test_output_order();
+    test_duplicate_tags();
+    test_limit();
+    test_threads();
+
+    if (failures)
+        fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}